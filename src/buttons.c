@@ -3,36 +3,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #include "ini.h"
+#include "buttons.h"
+#include "tasks.h"
+#include "metrics.h"
 
-#define MAX_BUTTONS 7
-#define BUTTON_BORDER_PX 2
-#define BUTTON_PADDING 50
-#define BUTTON_HEIGTH 50
-#define WINDOW_WIDTH 1360
-#define WINDOW_HEIGTH 768
 #define MAX_STRING_LENGTH 50
 
-typedef struct {
-    SDL_Rect rect;
-    const char* label;
-    const char* command;
-    Uint8 red, green, blue, alpha;
-    Uint8 text_red, text_green, text_blue, text_alpha;
-    Uint8 hover_red, hover_green, hover_blue, hover_alpha;
-} Button;
-
-typedef struct {
-    Button* button_ptr;
-    void* next;
-} Node;
-
-
-typedef enum {FALSE, TRUE} Bool;
-
 
+// Quiet on success: config files are parsed on worker threads, which would all queue on stdout.
 void* __new_t(size_t size, char* type){
-    printf("Allocating memory for %s\n", type);
     void* new = malloc(size);
     if (new == NULL){
         fprintf(stderr, "failed to allocate %s\n", type);
@@ -54,9 +36,9 @@ Button* new_button(){
 
 
 char* new_command(char* command){
+    // No trailing "&": the launcher forks and tracks the child itself.
     char* new_command = (char*)__new_t(strlen(command)+1, "string");
     strcpy(new_command, command);
-    strcat(new_command, "&");
     return new_command;
 }
 
@@ -75,19 +57,24 @@ Bool ends_with_extension(char* string, char* extension){
 }
 
 
-void draw_buttons_and_labels(Node* config, TTF_Font* font, SDL_Renderer* renderer, int mouse_x, int mouse_y){
+void draw_buttons_and_labels(Node* config, TTF_Font* font, SDL_Renderer* renderer, int mouse_x, int mouse_y, Button* focused){
+    unsigned long draw_calls = 0;
     Node* current = config;
     for (current; current != NULL; current = current->next){
         Button* btn_ptr = current->button_ptr;
 
-        // Check if the mouse is hovering the button
-        Bool is_hovered = is_button_hovered(btn_ptr, mouse_x, mouse_y);
+        // Skip buttons scrolled out of the window
+        if (btn_ptr->rect.y + btn_ptr->rect.h < 0 || btn_ptr->rect.y > WINDOW_HEIGTH) continue;
+
+        // Check if the mouse is hovering the button, or it has the keyboard/controller focus
+        Bool is_hovered = is_button_hovered(btn_ptr, mouse_x, mouse_y) || btn_ptr == focused;
 
         // Draw button border
         SDL_Rect border_rect = {btn_ptr->rect.x - BUTTON_BORDER_PX, btn_ptr->rect.y - BUTTON_BORDER_PX,
                                 btn_ptr->rect.w + 2*BUTTON_BORDER_PX, btn_ptr->rect.h + 2*BUTTON_BORDER_PX};
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
         SDL_RenderFillRect(renderer, &border_rect);
+        draw_calls++;
 
         // Draw button
         if (is_hovered)
@@ -96,118 +83,348 @@ void draw_buttons_and_labels(Node* config, TTF_Font* font, SDL_Renderer* rendere
             SDL_SetRenderDrawColor(renderer, btn_ptr->red, btn_ptr->green, btn_ptr->blue, btn_ptr->alpha);
 
         SDL_RenderFillRect(renderer, &btn_ptr->rect);
-
-        // Render label
-        SDL_Color text_color = {btn_ptr->text_red, btn_ptr->text_green, btn_ptr->text_blue, btn_ptr->text_alpha};
-        SDL_Surface* text_surface = TTF_RenderText_Solid(font, btn_ptr->label, text_color);
-        SDL_Texture* text_texture = SDL_CreateTextureFromSurface(renderer, text_surface);
-
-        // Get text width and height
-        int text_width = 0, text_height = 0;
-        SDL_QueryTexture(text_texture, NULL, NULL, &text_width, &text_height);
+        draw_calls++;
+
+        // Render label once and keep the texture around for the next frames
+        if (btn_ptr->label_texture != NULL) METRIC_ADD(texture_cache_hits, 1);
+        else {
+            METRIC_ADD(texture_cache_misses, 1);
+            SDL_Color text_color = {btn_ptr->text_red, btn_ptr->text_green, btn_ptr->text_blue, btn_ptr->text_alpha};
+            SDL_Surface* text_surface = TTF_RenderText_Solid(font, btn_ptr->label, text_color);
+            btn_ptr->label_texture = SDL_CreateTextureFromSurface(renderer, text_surface);
+            SDL_FreeSurface(text_surface);
+
+            // Get text width and height
+            SDL_QueryTexture(btn_ptr->label_texture, NULL, NULL, &btn_ptr->label_width, &btn_ptr->label_height);
+        }
 
         // Calculate position to center text on button
-        int text_x_coord = btn_ptr->rect.x + (btn_ptr->rect.w - text_width)/2;
-        int text_y_coord = btn_ptr->rect.y + (btn_ptr->rect.h - text_height)/2;
-
-        SDL_Rect text_rect = {text_x_coord, text_y_coord, text_width, text_height};
-        SDL_RenderCopy(renderer, text_texture, NULL, &text_rect);
+        int text_x_coord = btn_ptr->rect.x + (btn_ptr->rect.w - btn_ptr->label_width)/2;
+        int text_y_coord = btn_ptr->rect.y + (btn_ptr->rect.h - btn_ptr->label_height)/2;
+
+        SDL_Rect text_rect = {text_x_coord, text_y_coord, btn_ptr->label_width, btn_ptr->label_height};
+        SDL_RenderCopy(renderer, btn_ptr->label_texture, NULL, &text_rect);
+        draw_calls++;
+
+        // Show whether the program is running, waiting in the launch queue, can't be launched or was used recently
+        int status_key = btn_ptr->running ? -1 : btn_ptr->queue_position;
+        if (status_key == 0 && btn_ptr->is_broken) status_key = -3;
+        if (status_key == 0 && btn_ptr->is_recent) status_key = -2;
+        if (status_key != btn_ptr->status_key){
+            if (btn_ptr->status_texture) SDL_DestroyTexture(btn_ptr->status_texture);
+            btn_ptr->status_texture = NULL;
+            btn_ptr->status_key = status_key;
+        }
+        if (status_key == 0) continue;
+
+        if (btn_ptr->status_texture != NULL) METRIC_ADD(texture_cache_hits, 1);
+        else {
+            METRIC_ADD(texture_cache_misses, 1);
+            char status[MAX_STRING_LENGTH];
+            if (status_key == -1) sprintf(status, "running");
+            else if (status_key == -2) sprintf(status, "recent");
+            else if (status_key == -3) sprintf(status, "unavailable");
+            else sprintf(status, "queued #%d", status_key);
+
+            SDL_Color text_color = {btn_ptr->text_red, btn_ptr->text_green, btn_ptr->text_blue, btn_ptr->text_alpha};
+            SDL_Surface* status_surface = TTF_RenderText_Solid(font, status, text_color);
+            btn_ptr->status_texture = SDL_CreateTextureFromSurface(renderer, status_surface);
+            SDL_FreeSurface(status_surface);
+            SDL_QueryTexture(btn_ptr->status_texture, NULL, NULL, &btn_ptr->status_width, &btn_ptr->status_height);
+        }
 
-        SDL_DestroyTexture(text_texture);
-        SDL_FreeSurface(text_surface);
+        SDL_Rect status_rect = {btn_ptr->rect.x + btn_ptr->rect.w - btn_ptr->status_width - BUTTON_STATUS_MARGIN,
+                                btn_ptr->rect.y + (btn_ptr->rect.h - btn_ptr->status_height)/2,
+                                btn_ptr->status_width, btn_ptr->status_height};
+        SDL_RenderCopy(renderer, btn_ptr->status_texture, NULL, &status_rect);
+        draw_calls++;
     }
 
     SDL_RenderPresent(renderer);
+    METRIC_ADD(draw_calls, draw_calls);
+    METRIC_SET(last_frame_draw_calls, draw_calls);
 }
 
 
-static Button temp_button;
-static int button_index = -1;
+typedef struct {
+    const char* filename;
+    char* section;
+    Node* config;
+    Node** tail_ptr;
+    Button temp_button;
+    int button_index;
+    int status;
+} ConfigFile;
+
+
+// Drop whatever the last section left behind that never became a button.
+static void _reset_temp_button(ConfigFile* file_ptr){
+    free((char*)file_ptr->temp_button.label);
+    free((char*)file_ptr->temp_button.command);
+    memset(&file_ptr->temp_button, 0, sizeof(Button));
+}
 
 
 static int _config_handler(void* user, const char* section, const char* name, const char* value){
-    Node** config_ptr = (Node**)user;
-
-    // Used to compare with current sections
-    char title_buffer[10];
-    for (int index=0; index<MAX_BUTTONS; index++){
-        // Skip until the valid section is found
-        sprintf(title_buffer, "button_%d", index+1);
-        if (strcmp(section, title_buffer) != 0) continue;
-
-        if (index != button_index){
-            // Redefine index so we don't redefine rect each iteration.
-            button_index = index;
-
-            // Set rect attributes
-            temp_button.rect.x = BUTTON_PADDING;
-            temp_button.rect.y = (2 * index + 1) * BUTTON_HEIGTH;
-            temp_button.rect.w = WINDOW_WIDTH - 2 * BUTTON_PADDING;
-            temp_button.rect.h = BUTTON_HEIGTH;
-        }
+    ConfigFile* file_ptr = (ConfigFile*)user;
+    Button* temp_button = &file_ptr->temp_button;
 
-        // Set remaining button attributes.
-        if (strcmp(name, "label") == 0) temp_button.label = strdup(value);
-        else if (strcmp(name, "command") == 0) temp_button.command = new_command((char *)value);
-        else if (strcmp(name, "red") == 0) temp_button.red = (Uint8)atoi(value);
-        else if (strcmp(name, "green") == 0) temp_button.green = (Uint8)atoi(value);
-        else if (strcmp(name, "blue") == 0) temp_button.blue = (Uint8)atoi(value);
-        else if (strcmp(name, "alpha") == 0) temp_button.alpha = (Uint8)atoi(value);
-        else if (strcmp(name, "hover_red") == 0) temp_button.hover_red = (Uint8)atoi(value);
-        else if (strcmp(name, "hover_green") == 0) temp_button.hover_green = (Uint8)atoi(value);
-        else if (strcmp(name, "hover_blue") == 0) temp_button.hover_blue = (Uint8)atoi(value);
-        else if (strcmp(name, "hover_alpha") == 0) temp_button.hover_blue = (Uint8)atoi(value);
-        else if (strcmp(name, "text_red") == 0) temp_button.text_red = (Uint8)atoi(value);
-        else if (strcmp(name, "text_green") == 0) temp_button.text_green = (Uint8)atoi(value);
-        else if (strcmp(name, "text_blue") == 0) temp_button.text_blue = (Uint8)atoi(value);
-
-        // Set last attribute and append to list of buttons.
-        else if (strcmp(name, "text_alpha") == 0){
-            temp_button.text_alpha = (Uint8)atoi(value);
-
-            // Create a new node
-            Node* new = new_node();
-            new->button_ptr = new_button();
-
-            // Define the node button with the populated temp button.
-            *new->button_ptr = temp_button;
-
-            // Append new node to list
-            new->next = *config_ptr;
-            *config_ptr = new;
-        }
+    // Skip anything that is not a "button_<index>" section
+    int index;
+    if (sscanf(section, "button_%d", &index) != 1 || index < 1) return 1;
+
+    // Every section starts from an empty button, nothing carries over from the previous one.
+    if (index != file_ptr->button_index){
+        _reset_temp_button(file_ptr);
+        file_ptr->button_index = index;
+    }
+
+    // Set remaining button attributes.
+    if (strcmp(name, "label") == 0) temp_button->label = strdup(value);
+    else if (strcmp(name, "command") == 0) temp_button->command = new_command((char *)value);
+    else if (strcmp(name, "red") == 0) temp_button->red = (Uint8)atoi(value);
+    else if (strcmp(name, "green") == 0) temp_button->green = (Uint8)atoi(value);
+    else if (strcmp(name, "blue") == 0) temp_button->blue = (Uint8)atoi(value);
+    else if (strcmp(name, "alpha") == 0) temp_button->alpha = (Uint8)atoi(value);
+    else if (strcmp(name, "hover_red") == 0) temp_button->hover_red = (Uint8)atoi(value);
+    else if (strcmp(name, "hover_green") == 0) temp_button->hover_green = (Uint8)atoi(value);
+    else if (strcmp(name, "hover_blue") == 0) temp_button->hover_blue = (Uint8)atoi(value);
+    else if (strcmp(name, "hover_alpha") == 0) temp_button->hover_alpha = (Uint8)atoi(value);
+    else if (strcmp(name, "text_red") == 0) temp_button->text_red = (Uint8)atoi(value);
+    else if (strcmp(name, "text_green") == 0) temp_button->text_green = (Uint8)atoi(value);
+    else if (strcmp(name, "text_blue") == 0) temp_button->text_blue = (Uint8)atoi(value);
+
+    // Set last attribute and append to list of buttons.
+    else if (strcmp(name, "text_alpha") == 0){
+        temp_button->text_alpha = (Uint8)atoi(value);
+
+        // Create a new node
+        Node* new = new_node();
+        new->button_ptr = new_button();
+
+        // Define the node button with the populated temp button.
+        *new->button_ptr = *temp_button;
+        new->button_ptr->section = strdup(file_ptr->section);
+        new->button_ptr->label_texture = NULL;
+        new->button_ptr->status_texture = NULL;
+        new->button_ptr->status_key = 0;
+        new->button_ptr->running = 0;
+        new->button_ptr->queue_position = 0;
+        new->button_ptr->last_request_ticks = 0;
+        new->button_ptr->history_key = 0;
+        new->button_ptr->last_launch_time = 0;
+        new->button_ptr->usage_score = 0;
+        new->button_ptr->is_recent = FALSE;
+        new->button_ptr->launch_command = NULL;
+        new->button_ptr->is_broken = FALSE;
+        atomic_init(&new->button_ptr->launches, 0);
+
+        // The button owns the strings now.
+        temp_button->label = NULL;
+        temp_button->command = NULL;
+
+        // Append new node at the end of the list, keeping file order
+        new->next = NULL;
+        *file_ptr->tail_ptr = new;
+        file_ptr->tail_ptr = (Node**)&new->next;
     }
 
     return 1;
 }
 
 
-Node* load_config(const char* filename){
-    if (!ends_with_extension((char*)filename, ".ini")){
-        fprintf(stderr, "Provided file path is not a \".ini\" file\n");
+// Section name for a config file: its base name without the ".ini" extension.
+static char* _section_name(const char* filename){
+    const char* base = strrchr(filename, '/');
+    base = base ? base + 1 : filename;
+
+    char* section = strdup(base);
+    char* extension = strrchr(section, '.');
+    if (extension) *extension = '\0';
+    return section;
+}
+
+
+static void _parse_config_file(void* data, int index){
+    ConfigFile* file_ptr = &((ConfigFile*)data)[index];
+    file_ptr->section = _section_name(file_ptr->filename);
+    file_ptr->tail_ptr = &file_ptr->config;
+    file_ptr->status = ini_parse(file_ptr->filename, _config_handler, file_ptr);
+    _reset_temp_button(file_ptr);
+}
+
+
+static int _compare_strings(const void* first, const void* second){
+    return strcmp(*(char* const*)first, *(char* const*)second);
+}
+
+
+static void _push_filename(char*** filenames_ptr, int* count_ptr, int* capacity_ptr, char* filename){
+    if (*count_ptr == *capacity_ptr){
+        *capacity_ptr *= 2;
+        *filenames_ptr = realloc(*filenames_ptr, *capacity_ptr * sizeof(char*));
+        if (*filenames_ptr == NULL){
+            fprintf(stderr, "failed to allocate file list\n");
+            exit(1);
+        }
+    }
+
+    (*filenames_ptr)[(*count_ptr)++] = filename;
+}
+
+
+// Append the ".ini" files inside a directory to the list, sorted by name.
+static void _collect_directory(const char* path, char*** filenames_ptr, int* count_ptr, int* capacity_ptr){
+    DIR* directory = opendir(path);
+    if (directory == NULL){
+        fprintf(stderr, "Can't open directory \"%s\"\n", path);
         exit(1);
     }
 
-    printf("Loading config as linked list...\n");
+    int first = *count_ptr;
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL){
+        if (!ends_with_extension(entry->d_name, ".ini")) continue;
+
+        char* filename = __new_t(strlen(path) + strlen(entry->d_name) + 2, "string");
+        sprintf(filename, "%s/%s", path, entry->d_name);
+        _push_filename(filenames_ptr, count_ptr, capacity_ptr, filename);
+    }
+    closedir(directory);
+
+    qsort(*filenames_ptr + first, *count_ptr - first, sizeof(char*), _compare_strings);
+}
+
+
+Node* load_config(char** paths, int paths_count){
+    // Expand directories into their ".ini" files, keeping the given order.
+    int count = 0, capacity = 16;
+    char** filenames = __new_t(capacity * sizeof(char*), "file list");
+    for (int index=0; index<paths_count; index++){
+        struct stat path_stat;
+        if (stat(paths[index], &path_stat) == 0 && S_ISDIR(path_stat.st_mode)){
+            _collect_directory(paths[index], &filenames, &count, &capacity);
+            continue;
+        }
+
+        if (!ends_with_extension(paths[index], ".ini")){
+            fprintf(stderr, "Provided file path \"%s\" is not a \".ini\" file\n", paths[index]);
+            exit(1);
+        }
+
+        _push_filename(&filenames, &count, &capacity, strdup(paths[index]));
+    }
+
+    if (count == 0){
+        fprintf(stderr, "No \".ini\" files found\n");
+        exit(1);
+    }
+
+    printf("Loading config from %d file(s) as linked list...\n", count);
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    // One task per file, each one fills its own list.
+    ConfigFile* files = __new_t(count * sizeof(ConfigFile), "config files");
+    memset(files, 0, count * sizeof(ConfigFile));
+    for (int index=0; index<count; index++) files[index].filename = filenames[index];
+    run_tasks(_parse_config_file, files, count);
+
+    // Merge in file order so the result doesn't depend on thread timing.
     Node* config = NULL;
-    if (ini_parse(filename, _config_handler, &config) < 0){
-        fprintf(stderr, "Can't load \"%s\"", filename);
+    Node** tail_ptr = &config;
+    int loaded = 0;
+    for (int index=0; index<count; index++){
+        ConfigFile* file_ptr = &files[index];
+        if (file_ptr->status < 0) fprintf(stderr, "Can't load \"%s\"\n", file_ptr->filename);
+        else if (file_ptr->status > 0)
+            fprintf(stderr, "Error in \"%s\" at line %d\n", file_ptr->filename, file_ptr->status);
+        if (file_ptr->status >= 0) loaded++;
+
+        *tail_ptr = file_ptr->config;
+        while (*tail_ptr) tail_ptr = (Node**)&(*tail_ptr)->next;
+
+        free(file_ptr->section);
+        free(filenames[index]);
+    }
+    free(files);
+    free(filenames);
+
+    if (loaded == 0){
+        fprintf(stderr, "No config file could be loaded\n");
         exit(1);
     }
 
+    Uint64 elapsed_us = (SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency();
+    METRIC_SET(config_load_us, elapsed_us);
+    printf("Loaded %d of %d file(s) in %.2f ms\n", loaded, count, elapsed_us / 1000.0);
+
+    layout_buttons(config);
     return config;
 }
 
 
+// Stack buttons vertically following the list order.
+void layout_buttons(Node* config){
+    int index = 0;
+    Node* current = config;
+    for (; current != NULL; current = current->next, index++){
+        Button* btn_ptr = current->button_ptr;
+        btn_ptr->rect.x = BUTTON_PADDING;
+        btn_ptr->rect.y = (2 * index + 1) * BUTTON_HEIGTH;
+        btn_ptr->rect.w = WINDOW_WIDTH - 2 * BUTTON_PADDING;
+        btn_ptr->rect.h = BUTTON_HEIGTH;
+    }
+}
+
+
+// Move every button vertically, without letting the list leave the window.
+void scroll_buttons(Node* config, int delta_y){
+    if (config == NULL) return;
+
+    Node* last = config;
+    while (last->next) last = last->next;
+
+    int top = config->button_ptr->rect.y;
+    int bottom = last->button_ptr->rect.y + last->button_ptr->rect.h;
+
+    // Keep the last button above the bottom margin, then the first one below the top margin.
+    if (delta_y < WINDOW_HEIGTH - BUTTON_HEIGTH - bottom) delta_y = WINDOW_HEIGTH - BUTTON_HEIGTH - bottom;
+    if (delta_y > BUTTON_HEIGTH - top) delta_y = BUTTON_HEIGTH - top;
+    if (delta_y == 0) return;
+
+    Node* current = config;
+    for (; current != NULL; current = current->next)
+        current->button_ptr->rect.y += delta_y;
+}
+
+
 void print_config(Node* config){
+    const char* section = NULL;
     Node* current = config;
     while (current){
+        if (section == NULL || strcmp(section, current->button_ptr->section) != 0){
+            section = current->button_ptr->section;
+            printf("[%s]\n", section);
+        }
         printf("Label: %s; Command: %s.\n", current->button_ptr->label, current->button_ptr->command);
         current = current->next;
     }
 }
 
 
+void release_button_textures(Node* config){
+    Node* current = config;
+    for (; current != NULL; current = current->next){
+        Button* btn_ptr = current->button_ptr;
+        if (btn_ptr->label_texture) SDL_DestroyTexture(btn_ptr->label_texture);
+        if (btn_ptr->status_texture) SDL_DestroyTexture(btn_ptr->status_texture);
+        btn_ptr->label_texture = NULL;
+        btn_ptr->status_texture = NULL;
+        btn_ptr->status_key = 0;
+    }
+}
+
+
 void destroy_config(Node* config){
     while(config){
         Node* next = config->next;
@@ -215,6 +432,8 @@ void destroy_config(Node* config){
         printf("Freeing memory for button command and label...\n");
         free((char *)config->button_ptr->command);
         free((char *)config->button_ptr->label);
+        free((char *)config->button_ptr->section);
+        free((char *)config->button_ptr->launch_command);
 
         printf("Freeing allocated button...\n");
         free(config->button_ptr);
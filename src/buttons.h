@@ -5,21 +5,47 @@
     #include <SDL2/SDL_ttf.h>
     #include <stdio.h>
     #include <stdlib.h>
+    #include <stdatomic.h>
 
-    #define MAX_BUTTONS 5
     #define BUTTON_BORDER_PX 2
     #define BUTTON_PADDING 50
     #define BUTTON_HEIGTH 50
     #define WINDOW_WIDTH 1360
     #define WINDOW_HEIGTH 768
+    #define BUTTON_STATUS_MARGIN 10
+
+    typedef enum {FALSE, TRUE} Bool;
 
     typedef struct {
         SDL_Rect rect;
         const char* label;
         const char* command;
+        const char* section;
         Uint8 red, green, blue, alpha;
         Uint8 text_red, text_green, text_blue, text_alpha;
         Uint8 hover_red, hover_green, hover_blue, hover_alpha;
+
+        // Cached label texture, dropped whenever the renderer goes away.
+        SDL_Texture* label_texture;
+        int label_width, label_height;
+
+        // Launch state kept by the launcher, shown as a tag next to the label.
+        int running, queue_position;
+        Uint32 last_request_ticks;
+        SDL_Texture* status_texture;
+        int status_width, status_height, status_key;
+
+        // Command with its program resolved to an absolute path, see resolver.c.
+        const char* launch_command;
+        Bool is_broken;
+
+        // Launch history, see history.c.
+        Uint32 history_key, last_launch_time;
+        float usage_score;
+        Bool is_recent;
+
+        // Times this button launched its program, read by the metrics exporter.
+        atomic_ulong launches;
     } Button;
 
     typedef struct {
@@ -27,14 +53,15 @@
         void* next;
     } Node;
 
-    typedef enum {FALSE, TRUE} Bool;
-
-
+    void* __new_t(size_t size, char* type);
     Bool is_button_hovered(Button* button_ptr, int x_coord, int y_coord);
-    Node* load_config(char* filename);
+    Node* load_config(char** paths, int paths_count);
+    void layout_buttons(Node* config);
+    void scroll_buttons(Node* config, int delta_y);
     void print_config(Node* head);
     void destroy_config(Node* head);
     Node* new_node();
     Button* new_button();
-    void draw_buttons_and_labels(Node* config, TTF_Font* font, SDL_Renderer* renderer, int mouse_x, int mouse_y);
-#endif
\ No newline at end of file
+    void draw_buttons_and_labels(Node* config, TTF_Font* font, SDL_Renderer* renderer, int mouse_x, int mouse_y, Button* focused);
+    void release_button_textures(Node* config);
+#endif
@@ -0,0 +1,382 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <SDL2/SDL.h>
+#include "history.h"
+
+static SDL_Thread* writer_thread = NULL;
+static SDL_mutex* queue_lock = NULL;
+static SDL_cond* queue_ready = NULL;
+static HistoryRecord pending[HISTORY_QUEUE_SIZE];
+static int pending_count = 0;
+static Bool writer_stop = FALSE;
+
+static int history_fd = -1;
+static size_t history_records = 0;
+
+
+// History file path, LAUNCHER_HISTORY_FILE or a dot file in the home directory.
+static const char* _history_path(){
+    static char path[4096];
+    const char* env_path = getenv("LAUNCHER_HISTORY_FILE");
+    if (env_path) return env_path;
+
+    const char* home = getenv("HOME");
+    if (home == NULL) return NULL;
+
+    snprintf(path, sizeof(path), "%s/%s", home, HISTORY_FILENAME);
+    return path;
+}
+
+
+// FNV-1a over the section and label, so a button keeps its history across runs.
+static Uint32 _button_key(Button* btn_ptr){
+    Uint32 hash = 2166136261u;
+    const char* strings[2] = {btn_ptr->section ? btn_ptr->section : "", btn_ptr->label ? btn_ptr->label : ""};
+    for (int index=0; index<2; index++){
+        for (const char* character = strings[index]; *character; character++){
+            hash ^= (Uint8)*character;
+            hash *= 16777619u;
+        }
+
+        // Terminating zero byte, keeps "ab"+"c" apart from "a"+"bc".
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+static float _decay(float weight, Uint32 from_time, Uint32 to_time){
+    if (to_time <= from_time) return weight;
+    return weight * exp2f(-(float)(to_time - from_time) / HISTORY_HALF_LIFE_S);
+}
+
+
+// Map the records of a history file. Returns NULL when there is none or it is not ours.
+static HistoryRecord* _map_history(const char* path, size_t* count_ptr, void** map_ptr, size_t* map_size_ptr){
+    *count_ptr = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return NULL;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1 || (size_t)file_stat.st_size < sizeof(HistoryHeader)){
+        close(fd);
+        return NULL;
+    }
+
+    void* map = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    if (memcmp(((HistoryHeader*)map)->magic, HISTORY_MAGIC, 4) != 0){
+        fprintf(stderr, "Ignoring \"%s\", not a launch history file\n", path);
+        munmap(map, file_stat.st_size);
+        return NULL;
+    }
+
+    *map_ptr = map;
+    *map_size_ptr = file_stat.st_size;
+    *count_ptr = (file_stat.st_size - sizeof(HistoryHeader)) / sizeof(HistoryRecord);
+    return (HistoryRecord*)((char*)map + sizeof(HistoryHeader));
+}
+
+
+typedef struct {
+    Node* node;
+    int index;
+} RankedNode;
+
+
+static int _compare_recency(const void* first, const void* second){
+    const RankedNode* first_ptr = first;
+    const RankedNode* second_ptr = second;
+    Uint32 first_time = first_ptr->node->button_ptr->last_launch_time;
+    Uint32 second_time = second_ptr->node->button_ptr->last_launch_time;
+
+    if (first_time != second_time) return first_time > second_time ? -1 : 1;
+    return first_ptr->index - second_ptr->index;
+}
+
+
+// Recent section first by recency, then everything else by decayed launch count.
+static int _compare_rank(const void* first, const void* second){
+    const RankedNode* first_ptr = first;
+    const RankedNode* second_ptr = second;
+    Button* first_button = first_ptr->node->button_ptr;
+    Button* second_button = second_ptr->node->button_ptr;
+
+    if (first_button->is_recent != second_button->is_recent) return first_button->is_recent ? -1 : 1;
+    if (first_button->is_recent) return _compare_recency(first, second);
+    if (first_button->usage_score != second_button->usage_score)
+        return first_button->usage_score > second_button->usage_score ? -1 : 1;
+    return first_ptr->index - second_ptr->index;
+}
+
+
+// Order the buttons by how often and how recently they were launched, according
+// to the history file. Buttons never launched keep their config order.
+Node* rank_config(Node* config){
+    const char* path = _history_path();
+    if (path == NULL || config == NULL) return config;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    int count = 0;
+    for (Node* current = config; current != NULL; current = current->next) count++;
+
+    // Index buttons by key with open addressing, the table is at most half full.
+    int table_size = 1;
+    while (table_size < 2 * count) table_size <<= 1;
+    Button** table = calloc(table_size, sizeof(Button*));
+    if (table == NULL){
+        fprintf(stderr, "failed to allocate history table\n");
+        exit(1);
+    }
+    RankedNode* ranked = __new_t(count * sizeof(RankedNode), "ranked nodes");
+
+    int index = 0;
+    for (Node* current = config; current != NULL; current = current->next, index++){
+        Button* btn_ptr = current->button_ptr;
+        btn_ptr->history_key = _button_key(btn_ptr);
+        ranked[index].node = current;
+        ranked[index].index = index;
+
+        int slot = btn_ptr->history_key & (table_size - 1);
+        while (table[slot] && table[slot]->history_key != btn_ptr->history_key) slot = (slot + 1) & (table_size - 1);
+        if (table[slot] == NULL) table[slot] = btn_ptr;
+    }
+
+    // Fold every record into the button it belongs to.
+    Uint32 now = (Uint32)time(NULL);
+    void* map = NULL;
+    size_t map_size = 0, records_count = 0;
+    HistoryRecord* records = _map_history(path, &records_count, &map, &map_size);
+    for (size_t record=0; record<records_count; record++){
+        Uint32 key = records[record].key;
+        int slot = key & (table_size - 1);
+        while (table[slot] && table[slot]->history_key != key) slot = (slot + 1) & (table_size - 1);
+        if (table[slot] == NULL) continue;
+
+        Button* btn_ptr = table[slot];
+        btn_ptr->usage_score += _decay(records[record].weight, records[record].time, now);
+        if (records[record].time > btn_ptr->last_launch_time) btn_ptr->last_launch_time = records[record].time;
+    }
+    if (map) munmap(map, map_size);
+    free(table);
+
+    // The most recently launched buttons make up the recent section.
+    qsort(ranked, count, sizeof(RankedNode), _compare_recency);
+    for (index=0; index<count && index<HISTORY_RECENT_COUNT; index++){
+        Button* btn_ptr = ranked[index].node->button_ptr;
+        if (btn_ptr->last_launch_time == 0) break;
+        btn_ptr->is_recent = TRUE;
+    }
+
+    qsort(ranked, count, sizeof(RankedNode), _compare_rank);
+    for (index=0; index<count-1; index++) ranked[index].node->next = ranked[index+1].node;
+    ranked[count-1].node->next = NULL;
+    config = ranked[0].node;
+    free(ranked);
+
+    double elapsed_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    printf("Ranked %d buttons from %zu history records in %.3f ms\n", count, records_count, elapsed_ms);
+
+    layout_buttons(config);
+    return config;
+}
+
+
+static int _compare_records(const void* first, const void* second){
+    const HistoryRecord* first_ptr = first;
+    const HistoryRecord* second_ptr = second;
+    if (first_ptr->key != second_ptr->key) return first_ptr->key < second_ptr->key ? -1 : 1;
+    if (first_ptr->time != second_ptr->time) return first_ptr->time < second_ptr->time ? -1 : 1;
+    return 0;
+}
+
+
+static int _open_history(const char* path){
+    int fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1){
+        fprintf(stderr, "Can't open history file \"%s\"\n", path);
+        return -1;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1){
+        fprintf(stderr, "Can't stat history file \"%s\"\n", path);
+        close(fd);
+        return -1;
+    }
+
+    // Never append to a file that isn't ours. A header cut short by a crash still starts with the magic.
+    HistoryHeader header = {HISTORY_MAGIC, 1};
+    char magic[4];
+    size_t magic_size = file_stat.st_size < 4 ? (size_t)file_stat.st_size : 4;
+    if (magic_size > 0 && (pread(fd, magic, magic_size, 0) != (ssize_t)magic_size || memcmp(magic, header.magic, magic_size) != 0)){
+        fprintf(stderr, "Not writing to \"%s\", not a launch history file\n", path);
+        close(fd);
+        return -1;
+    }
+
+    if (file_stat.st_size < (off_t)sizeof(HistoryHeader)){
+        if (ftruncate(fd, 0) == -1 || write(fd, &header, sizeof(header)) != sizeof(header)){
+            fprintf(stderr, "Can't write history header to \"%s\"\n", path);
+            close(fd);
+            return -1;
+        }
+        history_records = 0;
+        return fd;
+    }
+
+    // Drop a record cut short by a crash so appends stay aligned.
+    size_t records_size = file_stat.st_size - sizeof(HistoryHeader);
+    if (records_size % sizeof(HistoryRecord)){
+        if (ftruncate(fd, file_stat.st_size - records_size % sizeof(HistoryRecord)) == -1){
+            fprintf(stderr, "Can't truncate history file \"%s\"\n", path);
+            close(fd);
+            return -1;
+        }
+    }
+    history_records = records_size / sizeof(HistoryRecord);
+    return fd;
+}
+
+
+// Rewrite the history with a single record per button, dropping the forgotten ones.
+static void _compact_history(const char* path){
+    void* map = NULL;
+    size_t map_size = 0, records_count = 0;
+    HistoryRecord* mapped = _map_history(path, &records_count, &map, &map_size);
+    if (mapped == NULL) return;
+    if (records_count == 0){
+        munmap(map, map_size);
+        return;
+    }
+
+    HistoryRecord* records = __new_t(records_count * sizeof(HistoryRecord), "history records");
+    memcpy(records, mapped, records_count * sizeof(HistoryRecord));
+    munmap(map, map_size);
+    qsort(records, records_count, sizeof(HistoryRecord), _compare_records);
+
+    // Records are sorted by time within a key, so the last one of a run is the newest.
+    Uint32 now = (Uint32)time(NULL);
+    size_t merged = 0;
+    for (size_t record=0; record<records_count;){
+        HistoryRecord result = records[record];
+        for (record++; record<records_count && records[record].key == result.key; record++){
+            result.weight = _decay(result.weight, result.time, records[record].time) + records[record].weight;
+            result.time = records[record].time;
+        }
+        if (_decay(result.weight, result.time, now) >= HISTORY_MIN_WEIGHT) records[merged++] = result;
+    }
+
+    char temp_path[4096];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE* stream = fopen(temp_path, "wb");
+    if (stream == NULL){
+        fprintf(stderr, "Can't write \"%s\"\n", temp_path);
+        free(records);
+        return;
+    }
+
+    HistoryHeader header = {HISTORY_MAGIC, 1};
+    fwrite(&header, sizeof(header), 1, stream);
+    fwrite(records, sizeof(HistoryRecord), merged, stream);
+    fclose(stream);
+    free(records);
+
+    if (rename(temp_path, path) == -1){
+        fprintf(stderr, "Can't replace \"%s\"\n", path);
+        return;
+    }
+
+    printf("Compacted launch history from %zu to %zu records\n", records_count, merged);
+    close(history_fd);
+    history_fd = _open_history(path);
+}
+
+
+static int _history_writer(void* user){
+    const char* path = (const char*)user;
+    if (history_records >= HISTORY_COMPACT_RECORDS) _compact_history(path);
+
+    HistoryRecord batch[HISTORY_QUEUE_SIZE];
+    Bool stop = FALSE;
+    while (!stop){
+        SDL_LockMutex(queue_lock);
+        while (pending_count == 0 && !writer_stop) SDL_CondWait(queue_ready, queue_lock);
+        int batch_count = pending_count;
+        memcpy(batch, pending, batch_count * sizeof(HistoryRecord));
+        pending_count = 0;
+        stop = writer_stop;
+        SDL_UnlockMutex(queue_lock);
+
+        if (batch_count == 0 || history_fd == -1) continue;
+        ssize_t batch_size = batch_count * sizeof(HistoryRecord);
+        if (write(history_fd, batch, batch_size) != batch_size){
+            fprintf(stderr, "Can't append to history file \"%s\"\n", path);
+            continue;
+        }
+        history_records += batch_count;
+
+        if (history_records >= HISTORY_COMPACT_RECORDS) _compact_history(path);
+    }
+
+    return 0;
+}
+
+
+// Launches are appended to the history from a thread of its own, so
+// record_launch never touches the disk.
+void start_history_writer(){
+    const char* path = _history_path();
+    if (path == NULL) return;
+
+    history_fd = _open_history(path);
+    if (history_fd == -1) return;
+
+    queue_lock = SDL_CreateMutex();
+    queue_ready = SDL_CreateCond();
+    writer_thread = SDL_CreateThread(_history_writer, "history_writer", (void*)path);
+    if (writer_thread == NULL) fprintf(stderr, "Failed to start history writer: %s\n", SDL_GetError());
+}
+
+
+void record_launch(Button* btn_ptr){
+    if (writer_thread == NULL) return;
+
+    HistoryRecord record = {btn_ptr->history_key, (Uint32)time(NULL), 1.0f};
+    btn_ptr->last_launch_time = record.time;
+
+    SDL_LockMutex(queue_lock);
+    if (pending_count < HISTORY_QUEUE_SIZE) pending[pending_count++] = record;
+    else fprintf(stderr, "History queue is full, not recording %s\n", btn_ptr->label);
+    SDL_CondSignal(queue_ready);
+    SDL_UnlockMutex(queue_lock);
+}
+
+
+void stop_history_writer(){
+    if (writer_thread){
+        SDL_LockMutex(queue_lock);
+        writer_stop = TRUE;
+        SDL_CondSignal(queue_ready);
+        SDL_UnlockMutex(queue_lock);
+
+        SDL_WaitThread(writer_thread, NULL);
+        writer_thread = NULL;
+        SDL_DestroyCond(queue_ready);
+        SDL_DestroyMutex(queue_lock);
+    }
+
+    if (history_fd != -1) close(history_fd);
+    history_fd = -1;
+}
@@ -0,0 +1,40 @@
+#ifndef HISTORY_H
+    #define HISTORY_H
+
+    #include <SDL2/SDL.h>
+    #include "buttons.h"
+
+    #define HISTORY_MAGIC "CLH1"
+    #define HISTORY_FILENAME ".csdl_launcher_history"
+
+    // Launches lose half of their weight in the ranking after this many seconds.
+    #define HISTORY_HALF_LIFE_S (30 * 24 * 60 * 60)
+
+    // Compact the file once it holds this many records, dropping entries whose
+    // weight decayed below HISTORY_MIN_WEIGHT.
+    #define HISTORY_COMPACT_RECORDS 4096
+    #define HISTORY_MIN_WEIGHT 0.01f
+
+    // Most recently launched buttons shown first, in their own section.
+    #define HISTORY_RECENT_COUNT 3
+
+    #define HISTORY_QUEUE_SIZE 64
+
+    typedef struct {
+        char magic[4];
+        Uint32 version;
+    } HistoryHeader;
+
+    // One launch, or all launches of a button once compacted: weight is the
+    // number of launches decayed to the time of the last one.
+    typedef struct {
+        Uint32 key;
+        Uint32 time;
+        float weight;
+    } HistoryRecord;
+
+    Node* rank_config(Node* config);
+    void start_history_writer();
+    void record_launch(Button* btn_ptr);
+    void stop_history_writer();
+#endif
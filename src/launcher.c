@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "launcher.h"
+#include "metrics.h"
+#include "history.h"
+
+typedef struct {
+    pid_t pid;
+    Button* button_ptr;
+} Child;
+
+static Child children[MAX_RUNNING_PROGRAMS];
+static int children_count = 0;
+
+// Pending launches, oldest first.
+static Button* launch_queue[LAUNCH_QUEUE_SIZE];
+static int queue_count = 0;
+
+
+pid_t launch_program(const char* command, const char* button_label){
+    printf("Attempting to launch %s\n", button_label);
+    pid_t pid = fork();
+    if (pid == -1){
+        fprintf(stderr, "Error launching program: %s\n", command);
+        METRIC_ADD(launch_failures, 1);
+        return -1;
+    }
+
+    if (pid == 0){
+        // Child: hand the command to the shell, same as system() would.
+        execl("/bin/sh", "sh", "-c", command, (char*)NULL);
+        _exit(127);
+    }
+
+    METRIC_ADD(children_started, 1);
+    METRIC_ADD(children_running, 1);
+    return pid;
+}
+
+
+static Bool _can_start(Button* btn_ptr){
+    return children_count < MAX_RUNNING_PROGRAMS && btn_ptr->running < MAX_RUNNING_PER_BUTTON;
+}
+
+
+static Bool _start(Button* btn_ptr){
+    const char* command = btn_ptr->launch_command ? btn_ptr->launch_command : btn_ptr->command;
+    pid_t pid = launch_program(command, btn_ptr->label);
+    if (pid == -1) return FALSE;
+
+    children[children_count].pid = pid;
+    children[children_count].button_ptr = btn_ptr;
+    children_count++;
+    btn_ptr->running++;
+    atomic_fetch_add_explicit(&btn_ptr->launches, 1, memory_order_relaxed);
+    record_launch(btn_ptr);
+    return TRUE;
+}
+
+
+// Keep every queued button's position in sync with the queue, for the UI.
+static void _update_queue_positions(){
+    for (int index=0; index<queue_count; index++)
+        launch_queue[index]->queue_position = index + 1;
+}
+
+
+// Start a button's program now if there is room for it, otherwise queue it.
+// Never blocks, so it is safe to call straight from the event loop.
+LaunchResult request_launch(Button* btn_ptr){
+    Uint32 now = SDL_GetTicks();
+    if (btn_ptr->last_request_ticks && now - btn_ptr->last_request_ticks < LAUNCH_DEBOUNCE_MS){
+        printf("Ignoring repeated click on %s\n", btn_ptr->label);
+        return LAUNCH_IGNORED;
+    }
+    btn_ptr->last_request_ticks = now;
+
+    if (btn_ptr->queue_position){
+        printf("%s is already queued\n", btn_ptr->label);
+        return LAUNCH_IGNORED;
+    }
+
+    if (btn_ptr->is_broken || btn_ptr->command == NULL){
+        fprintf(stderr, "Not launching %s, its program is unavailable\n", btn_ptr->label);
+        METRIC_ADD(launch_failures, 1);
+        return LAUNCH_FAILED;
+    }
+
+    if (queue_count == 0 && _can_start(btn_ptr))
+        return _start(btn_ptr) ? LAUNCH_STARTED : LAUNCH_FAILED;
+
+    if (queue_count == LAUNCH_QUEUE_SIZE){
+        fprintf(stderr, "Launch queue is full, dropping %s\n", btn_ptr->label);
+        return LAUNCH_IGNORED;
+    }
+
+    printf("Queueing %s\n", btn_ptr->label);
+    launch_queue[queue_count++] = btn_ptr;
+    _update_queue_positions();
+    return LAUNCH_QUEUED;
+}
+
+
+// Start the oldest queued launches that fit the limits. Returns how many started.
+int start_queued_launches(){
+    int started = 0;
+    int index = 0;
+    while (index < queue_count && children_count < MAX_RUNNING_PROGRAMS){
+        Button* btn_ptr = launch_queue[index];
+        if (!_can_start(btn_ptr)){
+            index++;
+            continue;
+        }
+
+        // Take it out of the queue whether or not it manages to start.
+        for (int next=index; next<queue_count-1; next++) launch_queue[next] = launch_queue[next+1];
+        queue_count--;
+        btn_ptr->queue_position = 0;
+
+        if (_start(btn_ptr)) started++;
+    }
+
+    _update_queue_positions();
+    return started;
+}
+
+
+// Collect every child that has exited without blocking. Returns how many did.
+int reap_children(){
+    int reaped = 0;
+    int status;
+    pid_t pid;
+    while (children_count > 0 && (pid = waitpid(-1, &status, WNOHANG)) > 0){
+        reaped++;
+        METRIC_ADD(children_exited, 1);
+        METRIC_ADD(children_running, -1);
+
+        // The shell exits with 127 when the program couldn't be found or run.
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 127) METRIC_ADD(launch_failures, 1);
+
+        // Free the slot the child was holding.
+        for (int index=0; index<children_count; index++){
+            if (children[index].pid != pid) continue;
+
+            children[index].button_ptr->running--;
+            children[index] = children[--children_count];
+            break;
+        }
+    }
+
+    return reaped;
+}
+
+
+int running_children(){
+    return children_count;
+}
+
+
+int queued_launches(){
+    return queue_count;
+}
@@ -0,0 +1,25 @@
+#ifndef LAUNCHER_H
+    #define LAUNCHER_H
+
+    #include <sys/types.h>
+    #include "buttons.h"
+
+    // Clicks on the same button closer than this are treated as one.
+    #define LAUNCH_DEBOUNCE_MS 500
+
+    // Programs allowed to run at once, overall and per button.
+    #define MAX_RUNNING_PROGRAMS 1
+    #define MAX_RUNNING_PER_BUTTON 1
+
+    // Launches waiting for a free slot, further ones are dropped.
+    #define LAUNCH_QUEUE_SIZE 16
+
+    typedef enum {LAUNCH_STARTED, LAUNCH_QUEUED, LAUNCH_IGNORED, LAUNCH_FAILED} LaunchResult;
+
+    pid_t launch_program(const char* command, const char* button_label);
+    LaunchResult request_launch(Button* btn_ptr);
+    int start_queued_launches();
+    int reap_children();
+    int running_children();
+    int queued_launches();
+#endif
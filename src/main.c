@@ -2,76 +2,183 @@
 #include <stdlib.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 #include "buttons.h"
+#include "launcher.h"
+#include "metrics.h"
+#include "history.h"
+#include "navigation.h"
+#include "resolver.h"
 
 #define FONT_PATH "/usr/share/fonts/truetype/dejavu/DejaVuSans-Bold.ttf"
 
+// How often to wake up while in background to check on launched programs.
+#define BACKGROUND_POLL_MS 250
 
-void launch_program(const char* command, const char* button_label){
-    printf("Attempting to launch %s\n", button_label);
-    int status = system(command);
-    if (status == -1) fprintf(stderr, "Error launching program: %s\n", command);
+// Also drop the renderer and font while in background, not only the textures.
+#define RELEASE_RENDERER_IN_BACKGROUND TRUE
+
+// Pixels moved per mouse wheel step.
+#define SCROLL_STEP BUTTON_HEIGTH
+
+
+// Hand resources back to the launched program while the launcher is not visible.
+void enter_background(Node* config, SDL_Renderer** renderer_ptr, TTF_Font** font_ptr){
+    printf("Entering background, releasing render resources...\n");
+    release_button_textures(config);
+    release_navigation();
+
+    if (RELEASE_RENDERER_IN_BACKGROUND){
+        if (*font_ptr) TTF_CloseFont(*font_ptr);
+        if (*renderer_ptr) SDL_DestroyRenderer(*renderer_ptr);
+        *font_ptr = NULL;
+        *renderer_ptr = NULL;
+    }
+
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+}
+
+
+// Ask for a button's program to start, moving to background if it started right away.
+void activate_button(Button* btn_ptr, Node* config, SDL_Renderer** renderer_ptr, TTF_Font** font_ptr, Bool* in_background_ptr){
+    if (request_launch(btn_ptr) != LAUNCH_STARTED || *in_background_ptr) return;
+
+    enter_background(config, renderer_ptr, font_ptr);
+    *in_background_ptr = TRUE;
 }
 
+
 int main(int argc, char** argv){
-    if (argc != 2){
-        fprintf(stderr, "Wrong amount of arguments. Usage: %s <buttons-config-ini-path>\n", argv[0]);
+    if (argc < 2){
+        fprintf(stderr, "Wrong amount of arguments. Usage: %s <buttons-config-ini-path|dir>...\n", argv[0]);
         return 1;
     }
 
-    char* buttons_config_path = argv[1];
-    Node* config = load_config(buttons_config_path);
+    Node* config = load_config(argv + 1, argc - 1);
+    config = rank_config(config);
     print_config(config);
+    start_command_resolution(config);
+    start_history_writer();
+    start_metrics_exporter(config);
 
-    SDL_Init(SDL_INIT_VIDEO);
+    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
     TTF_Init();
 
     SDL_Window* window = SDL_CreateWindow("Emulation Center", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
                                           WINDOW_WIDTH, WINDOW_HEIGTH, SDL_WINDOW_SHOWN);
-    
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    start_latency_measurement(window);
+
+    SDL_Renderer* renderer = NULL;
+    TTF_Font* font = NULL;
 
     Bool running = TRUE;
+    Bool in_background = FALSE;
+    Node* focused = config;
     SDL_Event event;
 
-    TTF_Font *font = TTF_OpenFont(FONT_PATH, 24);
-    if (!font){
-        fprintf(stderr, "Failed to load font: %s\n", TTF_GetError());
-        return 1;
-    }
-
     while(running) {
+        // Start whatever was waiting for a slot, and come back to the foreground
+        // once the launched programs are gone.
+        int reaped = reap_children();
+        if (start_queued_launches() > 0 && !in_background){
+            enter_background(config, &renderer, &font);
+            in_background = TRUE;
+        }
+        if (reaped > 0 && in_background && running_children() == 0){
+            printf("Launched program exited, resuming\n");
+            in_background = FALSE;
+            SDL_RaiseWindow(window);
+            recheck_command_resolution();
+        }
+        apply_resolved_commands(config);
+
+        // Don't spin while in background, just wait for events or a child to exit.
+        if (in_background) SDL_WaitEventTimeout(NULL, BACKGROUND_POLL_MS);
+        Uint64 frame_start = SDL_GetPerformanceCounter();
+
         int mouse_x, mouse_y;
         SDL_GetMouseState(&mouse_x, &mouse_y);
 
         while(SDL_PollEvent(&event)){
             if (event.type == SDL_QUIT) running = FALSE;
-            else if (event.type == SDL_MOUSEBUTTONDOWN){
+            else if (event.type == SDL_WINDOWEVENT){
+                Uint8 window_event = event.window.event;
+                if (window_event == SDL_WINDOWEVENT_HIDDEN || window_event == SDL_WINDOWEVENT_FOCUS_LOST){
+                    if (!in_background) enter_background(config, &renderer, &font);
+                    in_background = TRUE;
+                }
+                else if (window_event == SDL_WINDOWEVENT_SHOWN || window_event == SDL_WINDOWEVENT_FOCUS_GAINED)
+                    in_background = FALSE;
+            }
+            else if (event.type == SDL_MOUSEWHEEL && !in_background)
+                scroll_buttons(config, event.wheel.y * SCROLL_STEP);
+            else if (event.type == SDL_MOUSEBUTTONDOWN && !in_background){
                 int x_coord = event.button.x;
                 int y_coord = event.button.y;
-                int previous_heigth = 0;
 
                 Node* current = config;
-                for (current; current != NULL; current = current->next){
+                for (; current != NULL; current = current->next){
                     Button* btn_ptr = current->button_ptr;
                     if (is_button_hovered(btn_ptr, x_coord, y_coord))
-                        launch_program(btn_ptr->command, btn_ptr->label);
+                        activate_button(btn_ptr, config, &renderer, &font, &in_background);
+                }
+            }
+            else {
+                // Keyboard and controller, controllers get opened even while in background.
+                NavigationAction action = navigation_action(&event);
+                if (action == NAVIGATE_NONE || in_background || focused == NULL) continue;
+
+                if (action == NAVIGATE_ACTIVATE)
+                    activate_button(focused->button_ptr, config, &renderer, &font, &in_background);
+                else {
+                    mark_input(event.common.timestamp);
+                    focused = move_focus(config, focused, action);
                 }
             }
         }
 
+        if (in_background) continue;
+
+        NavigationAction repeated = repeat_navigation();
+        if (repeated != NAVIGATE_NONE && focused){
+            mark_input(SDL_GetTicks());
+            focused = move_focus(config, focused, repeated);
+        }
+
+        // Rebuild whatever was released while in background.
+        if (!renderer) renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+        if (!font){
+            font = TTF_OpenFont(FONT_PATH, 24);
+            if (!font){
+                fprintf(stderr, "Failed to load font: %s\n", TTF_GetError());
+                return 1;
+            }
+        }
+
         // Clear Screen
         SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
         SDL_RenderClear(renderer);
 
-        draw_buttons_and_labels(config, font, renderer, mouse_x, mouse_y);
+        draw_buttons_and_labels(config, font, renderer, mouse_x, mouse_y, focused ? focused->button_ptr : NULL);
+        mark_present();
+        record_frame_time((SDL_GetPerformanceCounter() - frame_start) * 1000000 / SDL_GetPerformanceFrequency());
     }
 
     printf("Closing program\n");
+    stop_metrics_exporter();
+    stop_history_writer();
+    stop_command_resolution();
+    report_latency();
+    close_controllers();
+    release_button_textures(config);
     destroy_config(config);
-    TTF_CloseFont(font);
+    if (font) TTF_CloseFont(font);
     TTF_Quit();
-    SDL_DestroyRenderer(renderer);
+    if (renderer) SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
-}
\ No newline at end of file
+}
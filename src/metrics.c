@@ -0,0 +1,282 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <SDL2/SDL.h>
+#include "metrics.h"
+
+// How long the exporter blocks waiting for a client before checking other work.
+#define EXPORTER_POLL_MS 500
+
+// How long to wait for a client to send its request before answering anyway.
+#define CLIENT_REQUEST_WAIT_MS 100
+
+Metrics metrics;
+
+static const Uint64 frame_time_bounds_us[FRAME_TIME_BUCKETS] = FRAME_TIME_BOUNDS_US;
+
+static SDL_Thread* exporter_thread = NULL;
+static SDL_atomic_t exporter_stop;
+static Node* exported_config = NULL;
+static const char* socket_path = NULL;
+static const char* file_path = NULL;
+static int listen_fd = -1;
+
+
+void record_frame_time(Uint64 frame_time_us){
+    int bucket = 0;
+    while (bucket < FRAME_TIME_BUCKETS && frame_time_us > frame_time_bounds_us[bucket]) bucket++;
+
+    METRIC_ADD(frames_rendered, 1);
+    METRIC_ADD(frame_time_buckets[bucket], 1);
+    METRIC_ADD(frame_time_sum_us, frame_time_us);
+}
+
+
+// Upper bound of the bucket holding the given quantile, in seconds.
+static double _frame_time_percentile(unsigned long* buckets, unsigned long total, double quantile){
+    unsigned long cumulative = 0;
+    for (int bucket=0; bucket<FRAME_TIME_BUCKETS; bucket++){
+        cumulative += buckets[bucket];
+        if (cumulative >= quantile * total) return frame_time_bounds_us[bucket] / 1e6;
+    }
+
+    return frame_time_bounds_us[FRAME_TIME_BUCKETS - 1] / 1e6;
+}
+
+
+// Print a label value escaped as the Prometheus text format expects.
+static void _write_label_value(FILE* stream, const char* value){
+    for (; *value; value++){
+        if (*value == '\\') fputs("\\\\", stream);
+        else if (*value == '"') fputs("\\\"", stream);
+        else if (*value == '\n') fputs("\\n", stream);
+        else fputc(*value, stream);
+    }
+}
+
+
+static void _write_metric(FILE* stream, const char* name, const char* type, const char* help, double value){
+    fprintf(stream, "# HELP %s %s\n# TYPE %s %s\n%s %.15g\n", name, help, name, type, name, value);
+}
+
+
+void write_metrics(FILE* stream, Node* config){
+    _write_metric(stream, "launcher_frames_rendered_total", "counter", "Frames presented.",
+                  METRIC_GET(frames_rendered));
+
+    // Snapshot the histogram so buckets, sum and count agree with each other.
+    unsigned long buckets[FRAME_TIME_BUCKETS + 1];
+    unsigned long total = 0;
+    for (int bucket=0; bucket<=FRAME_TIME_BUCKETS; bucket++){
+        buckets[bucket] = METRIC_GET(frame_time_buckets[bucket]);
+        total += buckets[bucket];
+    }
+
+    fprintf(stream, "# HELP launcher_frame_time_seconds Time spent per rendered frame.\n");
+    fprintf(stream, "# TYPE launcher_frame_time_seconds histogram\n");
+    unsigned long cumulative = 0;
+    for (int bucket=0; bucket<FRAME_TIME_BUCKETS; bucket++){
+        cumulative += buckets[bucket];
+        fprintf(stream, "launcher_frame_time_seconds_bucket{le=\"%g\"} %lu\n", frame_time_bounds_us[bucket] / 1e6, cumulative);
+    }
+    fprintf(stream, "launcher_frame_time_seconds_bucket{le=\"+Inf\"} %lu\n", total);
+    fprintf(stream, "launcher_frame_time_seconds_sum %g\n", METRIC_GET(frame_time_sum_us) / 1e6);
+    fprintf(stream, "launcher_frame_time_seconds_count %lu\n", total);
+
+    fprintf(stream, "# HELP launcher_frame_time_percentile_seconds Frame time percentiles estimated from the histogram.\n");
+    fprintf(stream, "# TYPE launcher_frame_time_percentile_seconds gauge\n");
+    double quantiles[] = {0.5, 0.9, 0.99};
+    for (int index=0; index<3; index++)
+        fprintf(stream, "launcher_frame_time_percentile_seconds{quantile=\"%g\"} %g\n", quantiles[index],
+                total ? _frame_time_percentile(buckets, total, quantiles[index]) : 0.0);
+
+    _write_metric(stream, "launcher_draw_calls_total", "counter", "Draw calls issued.",
+                  METRIC_GET(draw_calls));
+    _write_metric(stream, "launcher_draw_calls_last_frame", "gauge", "Draw calls issued by the last frame.",
+                  METRIC_GET(last_frame_draw_calls));
+    _write_metric(stream, "launcher_texture_cache_hits_total", "counter", "Label textures reused from the cache.",
+                  METRIC_GET(texture_cache_hits));
+    _write_metric(stream, "launcher_texture_cache_misses_total", "counter", "Label textures that had to be rendered.",
+                  METRIC_GET(texture_cache_misses));
+    _write_metric(stream, "launcher_config_load_seconds", "gauge", "Time spent loading the button config.",
+                  METRIC_GET(config_load_us) / 1e6);
+
+    fprintf(stream, "# HELP launcher_launches_total Programs launched per button.\n");
+    fprintf(stream, "# TYPE launcher_launches_total counter\n");
+    Node* current = config;
+    for (; current != NULL; current = current->next){
+        Button* btn_ptr = current->button_ptr;
+        fprintf(stream, "launcher_launches_total{section=\"");
+        _write_label_value(stream, btn_ptr->section ? btn_ptr->section : "");
+        fprintf(stream, "\",button=\"");
+        _write_label_value(stream, btn_ptr->label ? btn_ptr->label : "");
+        fprintf(stream, "\"} %lu\n", atomic_load_explicit(&btn_ptr->launches, memory_order_relaxed));
+    }
+
+    _write_metric(stream, "launcher_launch_failures_total", "counter", "Programs that could not be started.",
+                  METRIC_GET(launch_failures));
+    _write_metric(stream, "launcher_children_started_total", "counter", "Child processes started.",
+                  METRIC_GET(children_started));
+    _write_metric(stream, "launcher_children_exited_total", "counter", "Child processes reaped.",
+                  METRIC_GET(children_exited));
+    _write_metric(stream, "launcher_children_running", "gauge", "Child processes currently running.",
+                  METRIC_GET(children_running));
+    _write_metric(stream, "launcher_input_latency_samples_total", "counter", "Inputs measured up to their present.",
+                  METRIC_GET(input_latency_samples));
+    _write_metric(stream, "launcher_input_latency_seconds_total", "counter", "Summed input to present latency.",
+                  METRIC_GET(input_latency_sum_ms) / 1e3);
+    _write_metric(stream, "launcher_input_latency_over_frame_total", "counter", "Inputs presented later than one frame.",
+                  METRIC_GET(input_latency_over_frame));
+}
+
+
+// Rewrite the metrics file through a temporary one so readers never see half of it.
+static void _write_metrics_file(){
+    char temp_path[4096];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", file_path);
+
+    FILE* stream = fopen(temp_path, "w");
+    if (stream == NULL){
+        fprintf(stderr, "Can't write metrics file \"%s\"\n", temp_path);
+        return;
+    }
+
+    write_metrics(stream, exported_config);
+    fclose(stream);
+    rename(temp_path, file_path);
+}
+
+
+static void _serve_client(int client_fd){
+    // Read whatever request the client sent, answering plain HTTP when it asked for it.
+    char request[1024];
+    ssize_t request_length = 0;
+    struct pollfd client_poll = {client_fd, POLLIN, 0};
+    if (poll(&client_poll, 1, CLIENT_REQUEST_WAIT_MS) > 0)
+        request_length = recv(client_fd, request, sizeof(request) - 1, MSG_DONTWAIT);
+    Bool is_http = request_length >= 4 && strncmp(request, "GET ", 4) == 0;
+
+    char* body = NULL;
+    size_t body_length = 0;
+    FILE* stream = open_memstream(&body, &body_length);
+    if (stream == NULL){
+        close(client_fd);
+        return;
+    }
+    write_metrics(stream, exported_config);
+    fclose(stream);
+
+    if (is_http){
+        char header[128];
+        int header_length = snprintf(header, sizeof(header),
+                                     "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                     "Content-Length: %zu\r\n\r\n", body_length);
+        send(client_fd, header, header_length, MSG_NOSIGNAL);
+    }
+
+    send(client_fd, body, body_length, MSG_NOSIGNAL);
+    free(body);
+    close(client_fd);
+}
+
+
+static int _open_metrics_socket(){
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address.sun_path)){
+        fprintf(stderr, "Metrics socket path is too long: %s\n", socket_path);
+        return -1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1){
+        fprintf(stderr, "Can't create metrics socket\n");
+        return -1;
+    }
+
+    // Remove a socket left over by a previous run, but never anything else.
+    struct stat socket_stat;
+    if (lstat(socket_path, &socket_stat) == 0){
+        if (!S_ISSOCK(socket_stat.st_mode)){
+            fprintf(stderr, "Metrics socket path \"%s\" exists and is not a socket\n", socket_path);
+            close(fd);
+            return -1;
+        }
+        unlink(socket_path);
+    }
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) == -1 || listen(fd, 4) == -1){
+        fprintf(stderr, "Can't listen on metrics socket \"%s\"\n", socket_path);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+
+static int _exporter(void* user){
+    Uint32 next_file_write = SDL_GetTicks();
+    while (!SDL_AtomicGet(&exporter_stop)){
+        if (file_path && (Sint32)(SDL_GetTicks() - next_file_write) >= 0){
+            _write_metrics_file();
+            next_file_write = SDL_GetTicks() + METRICS_FILE_INTERVAL_MS;
+        }
+
+        if (listen_fd == -1){
+            SDL_Delay(EXPORTER_POLL_MS);
+            continue;
+        }
+
+        struct pollfd listen_poll = {listen_fd, POLLIN, 0};
+        if (poll(&listen_poll, 1, EXPORTER_POLL_MS) <= 0) continue;
+
+        int client_fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client_fd != -1) _serve_client(client_fd);
+    }
+
+    return 0;
+}
+
+
+// Serve metrics on LAUNCHER_METRICS_SOCKET and/or write them to LAUNCHER_METRICS_FILE.
+// Does nothing when neither is set.
+void start_metrics_exporter(Node* config){
+    socket_path = getenv("LAUNCHER_METRICS_SOCKET");
+    file_path = getenv("LAUNCHER_METRICS_FILE");
+    if (socket_path == NULL && file_path == NULL) return;
+
+    exported_config = config;
+    if (socket_path) listen_fd = _open_metrics_socket();
+    if (listen_fd == -1 && file_path == NULL) return;
+
+    SDL_AtomicSet(&exporter_stop, 0);
+    exporter_thread = SDL_CreateThread(_exporter, "metrics_exporter", NULL);
+    if (exporter_thread == NULL) fprintf(stderr, "Failed to start metrics exporter: %s\n", SDL_GetError());
+    else printf("Exporting metrics%s%s%s%s\n", listen_fd != -1 ? " on " : "", listen_fd != -1 ? socket_path : "",
+                file_path ? " to " : "", file_path ? file_path : "");
+}
+
+
+void stop_metrics_exporter(){
+    if (exporter_thread){
+        SDL_AtomicSet(&exporter_stop, 1);
+        SDL_WaitThread(exporter_thread, NULL);
+        exporter_thread = NULL;
+
+        // Leave a final snapshot behind.
+        if (file_path) _write_metrics_file();
+    }
+
+    if (listen_fd != -1){
+        close(listen_fd);
+        unlink(socket_path);
+        listen_fd = -1;
+    }
+}
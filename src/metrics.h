@@ -0,0 +1,45 @@
+#ifndef METRICS_H
+    #define METRICS_H
+
+    #include <stdio.h>
+    #include <stdatomic.h>
+    #include <SDL2/SDL.h>
+    #include "buttons.h"
+
+    // Frame time histogram bucket upper bounds, in microseconds.
+    #define FRAME_TIME_BUCKETS 10
+    #define FRAME_TIME_BOUNDS_US {1000, 2000, 4000, 8000, 16667, 33333, 66667, 125000, 250000, 500000}
+
+    // How often the metrics file is rewritten, when enabled.
+    #define METRICS_FILE_INTERVAL_MS 10000
+
+    typedef struct {
+        atomic_ulong frames_rendered;
+        atomic_ulong frame_time_buckets[FRAME_TIME_BUCKETS + 1];
+        atomic_ulong frame_time_sum_us;
+        atomic_ulong draw_calls;
+        atomic_ulong last_frame_draw_calls;
+        atomic_ulong texture_cache_hits;
+        atomic_ulong texture_cache_misses;
+        atomic_ulong config_load_us;
+        atomic_ulong launch_failures;
+        atomic_ulong children_started;
+        atomic_ulong children_exited;
+        atomic_long children_running;
+        atomic_ulong input_latency_samples;
+        atomic_ulong input_latency_sum_ms;
+        atomic_ulong input_latency_over_frame;
+    } Metrics;
+
+    extern Metrics metrics;
+
+    // Relaxed on purpose: counters are only ever read by the exporter.
+    #define METRIC_ADD(name, value) atomic_fetch_add_explicit(&metrics.name, (value), memory_order_relaxed)
+    #define METRIC_SET(name, value) atomic_store_explicit(&metrics.name, (value), memory_order_relaxed)
+    #define METRIC_GET(name) atomic_load_explicit(&metrics.name, memory_order_relaxed)
+
+    void record_frame_time(Uint64 frame_time_us);
+    void write_metrics(FILE* stream, Node* config);
+    void start_metrics_exporter(Node* config);
+    void stop_metrics_exporter();
+#endif
@@ -0,0 +1,305 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include "navigation.h"
+#include "metrics.h"
+
+typedef enum {HELD_BY_KEYBOARD, HELD_BY_BUTTON, HELD_BY_AXIS} HeldSource;
+
+static SDL_GameController* controllers[MAX_CONTROLLERS];
+
+static NavigationAction held_action = NAVIGATE_NONE;
+static HeldSource held_source;
+static Uint32 next_repeat_ticks = 0;
+static NavigationAction axis_actions[2] = {NAVIGATE_NONE, NAVIGATE_NONE};
+
+static Bool measuring = FALSE;
+static Bool input_pending = FALSE;
+static Uint32 pending_input_ticks = 0;
+static Uint32 frame_budget_ms = (1000 + DEFAULT_REFRESH_RATE - 1) / DEFAULT_REFRESH_RATE;
+static unsigned long latency_samples = 0, latency_over_budget = 0, latency_sum_ms = 0, latency_max_ms = 0;
+
+
+static void _open_controller(int device_index){
+    if (!SDL_IsGameController(device_index)) return;
+
+    for (int index=0; index<MAX_CONTROLLERS; index++){
+        if (controllers[index]) continue;
+
+        controllers[index] = SDL_GameControllerOpen(device_index);
+        if (controllers[index]) printf("Opened controller %s\n", SDL_GameControllerName(controllers[index]));
+        return;
+    }
+}
+
+
+static void _close_controller(SDL_JoystickID instance_id){
+    SDL_GameController* controller = SDL_GameControllerFromInstanceID(instance_id);
+    for (int index=0; index<MAX_CONTROLLERS; index++){
+        if (controllers[index] != controller) continue;
+
+        SDL_GameControllerClose(controllers[index]);
+        controllers[index] = NULL;
+        release_navigation();
+        return;
+    }
+}
+
+
+void close_controllers(){
+    for (int index=0; index<MAX_CONTROLLERS; index++){
+        if (controllers[index]) SDL_GameControllerClose(controllers[index]);
+        controllers[index] = NULL;
+    }
+}
+
+
+static NavigationAction _key_action(SDL_Keysym keysym){
+    switch (keysym.sym){
+        case SDLK_UP: return NAVIGATE_UP;
+        case SDLK_DOWN: return NAVIGATE_DOWN;
+        case SDLK_LEFT: return NAVIGATE_LEFT;
+        case SDLK_RIGHT: return NAVIGATE_RIGHT;
+        case SDLK_TAB: return (keysym.mod & KMOD_SHIFT) ? NAVIGATE_PREVIOUS : NAVIGATE_NEXT;
+        case SDLK_RETURN: case SDLK_KP_ENTER: case SDLK_SPACE: return NAVIGATE_ACTIVATE;
+        default: return NAVIGATE_NONE;
+    }
+}
+
+
+static NavigationAction _controller_button_action(Uint8 button){
+    switch (button){
+        case SDL_CONTROLLER_BUTTON_DPAD_UP: return NAVIGATE_UP;
+        case SDL_CONTROLLER_BUTTON_DPAD_DOWN: return NAVIGATE_DOWN;
+        case SDL_CONTROLLER_BUTTON_DPAD_LEFT: return NAVIGATE_LEFT;
+        case SDL_CONTROLLER_BUTTON_DPAD_RIGHT: return NAVIGATE_RIGHT;
+        case SDL_CONTROLLER_BUTTON_LEFTSHOULDER: return NAVIGATE_PREVIOUS;
+        case SDL_CONTROLLER_BUTTON_RIGHTSHOULDER: return NAVIGATE_NEXT;
+        case SDL_CONTROLLER_BUTTON_A: return NAVIGATE_ACTIVATE;
+        default: return NAVIGATE_NONE;
+    }
+}
+
+
+static void _hold(NavigationAction action, HeldSource source){
+    if (action == NAVIGATE_NONE || action == NAVIGATE_ACTIVATE) return;
+
+    held_action = action;
+    held_source = source;
+    next_repeat_ticks = SDL_GetTicks() + NAVIGATION_REPEAT_DELAY_MS;
+}
+
+
+// Stop repeating, only when the released input is the one being held.
+static void _release(NavigationAction action, HeldSource source){
+    if (held_source == source && held_action == action) held_action = NAVIGATE_NONE;
+}
+
+
+// The left stick acts as a d-pad, firing once each time it leaves the deadzone.
+static NavigationAction _axis_action(Uint8 axis, Sint16 value){
+    if (axis != SDL_CONTROLLER_AXIS_LEFTX && axis != SDL_CONTROLLER_AXIS_LEFTY) return NAVIGATE_NONE;
+
+    NavigationAction action = NAVIGATE_NONE;
+    if (value < -CONTROLLER_AXIS_DEADZONE) action = axis == SDL_CONTROLLER_AXIS_LEFTX ? NAVIGATE_LEFT : NAVIGATE_UP;
+    else if (value > CONTROLLER_AXIS_DEADZONE) action = axis == SDL_CONTROLLER_AXIS_LEFTX ? NAVIGATE_RIGHT : NAVIGATE_DOWN;
+    if (action == axis_actions[axis]) return NAVIGATE_NONE;
+
+    _release(axis_actions[axis], HELD_BY_AXIS);
+    axis_actions[axis] = action;
+    _hold(action, HELD_BY_AXIS);
+    return action;
+}
+
+
+// Translate keyboard and controller events into navigation, also keeping track
+// of held directions and of controllers being plugged in or out.
+NavigationAction navigation_action(SDL_Event* event){
+    NavigationAction action;
+    switch (event->type){
+        case SDL_CONTROLLERDEVICEADDED:
+            _open_controller(event->cdevice.which);
+            return NAVIGATE_NONE;
+
+        case SDL_CONTROLLERDEVICEREMOVED:
+            _close_controller(event->cdevice.which);
+            return NAVIGATE_NONE;
+
+        // Key repeats come from repeat_navigation instead, with the same timing as controllers.
+        case SDL_KEYDOWN:
+            if (event->key.repeat) return NAVIGATE_NONE;
+            action = _key_action(event->key.keysym);
+            _hold(action, HELD_BY_KEYBOARD);
+            return action;
+
+        case SDL_KEYUP:
+            action = _key_action(event->key.keysym);
+
+            // Shift may be let go before Tab, so Tab releases either direction.
+            if (event->key.keysym.sym == SDLK_TAB && (held_action == NAVIGATE_NEXT || held_action == NAVIGATE_PREVIOUS))
+                action = held_action;
+            _release(action, HELD_BY_KEYBOARD);
+            return NAVIGATE_NONE;
+
+        case SDL_CONTROLLERBUTTONDOWN:
+            action = _controller_button_action(event->cbutton.button);
+            _hold(action, HELD_BY_BUTTON);
+            return action;
+
+        case SDL_CONTROLLERBUTTONUP:
+            _release(_controller_button_action(event->cbutton.button), HELD_BY_BUTTON);
+            return NAVIGATE_NONE;
+
+        case SDL_CONTROLLERAXISMOTION:
+            return _axis_action(event->caxis.axis, event->caxis.value);
+
+        default:
+            return NAVIGATE_NONE;
+    }
+}
+
+
+// The held direction, whenever it is due to repeat.
+NavigationAction repeat_navigation(){
+    if (held_action == NAVIGATE_NONE) return NAVIGATE_NONE;
+
+    Uint32 now = SDL_GetTicks();
+    if ((Sint32)(now - next_repeat_ticks) < 0) return NAVIGATE_NONE;
+
+    // Don't fire a burst of repeats to catch up after a stall.
+    next_repeat_ticks = now + NAVIGATION_REPEAT_INTERVAL_MS;
+    return held_action;
+}
+
+
+// Forget held directions, their release may never arrive once focus is lost.
+void release_navigation(){
+    held_action = NAVIGATE_NONE;
+    axis_actions[0] = axis_actions[1] = NAVIGATE_NONE;
+}
+
+
+static Node* _previous_node(Node* config, Node* focused){
+    Node* previous = NULL;
+    Node* current = config;
+    for (; current != NULL; current = current->next){
+        if (current->next == focused) return current;
+        previous = current;
+    }
+
+    // Wrap around to the last button.
+    return previous;
+}
+
+
+// Closest button in the given direction, favouring the ones straight ahead.
+static Node* _neighbor_node(Node* config, Node* focused, NavigationAction action){
+    SDL_Rect* from = &focused->button_ptr->rect;
+    int from_x = from->x + from->w/2, from_y = from->y + from->h/2;
+
+    Node* best = NULL;
+    long best_distance = 0;
+    Node* current = config;
+    for (; current != NULL; current = current->next){
+        if (current == focused) continue;
+
+        SDL_Rect* to = &current->button_ptr->rect;
+        long delta_x = to->x + to->w/2 - from_x, delta_y = to->y + to->h/2 - from_y;
+        long ahead, aside;
+        if (action == NAVIGATE_UP){ ahead = -delta_y; aside = labs(delta_x); }
+        else if (action == NAVIGATE_DOWN){ ahead = delta_y; aside = labs(delta_x); }
+        else if (action == NAVIGATE_LEFT){ ahead = -delta_x; aside = labs(delta_y); }
+        else { ahead = delta_x; aside = labs(delta_y); }
+        if (ahead <= 0) continue;
+
+        long distance = ahead + 2 * aside;
+        if (best == NULL || distance < best_distance){
+            best = current;
+            best_distance = distance;
+        }
+    }
+
+    return best;
+}
+
+
+// Move the focus and scroll the list so the focused button stays in the window.
+Node* move_focus(Node* config, Node* focused, NavigationAction action){
+    if (config == NULL) return NULL;
+    if (focused == NULL) return config;
+
+    Node* target = NULL;
+    if (action == NAVIGATE_NEXT) target = focused->next ? focused->next : config;
+    else if (action == NAVIGATE_PREVIOUS) target = _previous_node(config, focused);
+    else if (action != NAVIGATE_NONE && action != NAVIGATE_ACTIVATE){
+        target = _neighbor_node(config, focused, action);
+
+        // With a single column, left and right walk the button order instead.
+        if (target == NULL && action == NAVIGATE_LEFT) target = _previous_node(config, focused);
+        else if (target == NULL && action == NAVIGATE_RIGHT) target = focused->next ? focused->next : config;
+    }
+    if (target == NULL) return focused;
+
+    SDL_Rect* rect = &target->button_ptr->rect;
+    if (rect->y < BUTTON_HEIGTH) scroll_buttons(config, BUTTON_HEIGTH - rect->y);
+    else if (rect->y + rect->h > WINDOW_HEIGTH - BUTTON_HEIGTH)
+        scroll_buttons(config, WINDOW_HEIGTH - BUTTON_HEIGTH - rect->y - rect->h);
+
+    return target;
+}
+
+
+// Measure input to present latency when LAUNCHER_MEASURE_LATENCY is set, against
+// the frame budget of the display holding the window.
+void start_latency_measurement(SDL_Window* window){
+    const char* measure = getenv("LAUNCHER_MEASURE_LATENCY");
+    if (measure == NULL || measure[0] == '\0' || measure[0] == '0') return;
+
+    SDL_DisplayMode mode;
+    int refresh_rate = DEFAULT_REFRESH_RATE;
+    if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode) == 0 && mode.refresh_rate > 0)
+        refresh_rate = mode.refresh_rate;
+
+    // Round up: latencies are whole ticks, so 17 ms still fits a 16.67 ms frame.
+    frame_budget_ms = (1000 + refresh_rate - 1) / refresh_rate;
+    measuring = TRUE;
+    printf("Measuring input latency, frame budget is %u ms\n", frame_budget_ms);
+}
+
+
+// Remember when the oldest input not yet on screen happened.
+void mark_input(Uint32 timestamp){
+    if (!measuring || input_pending) return;
+
+    input_pending = TRUE;
+    pending_input_ticks = timestamp;
+}
+
+
+// Called right after SDL_RenderPresent, closes the pending input if there is one.
+void mark_present(){
+    if (!input_pending) return;
+    input_pending = FALSE;
+
+    Uint32 latency_ms = SDL_GetTicks() - pending_input_ticks;
+    Bool over_budget = latency_ms > frame_budget_ms;
+
+    latency_samples++;
+    latency_sum_ms += latency_ms;
+    if (latency_ms > latency_max_ms) latency_max_ms = latency_ms;
+    if (over_budget) latency_over_budget++;
+
+    METRIC_ADD(input_latency_samples, 1);
+    METRIC_ADD(input_latency_sum_ms, latency_ms);
+    if (over_budget) METRIC_ADD(input_latency_over_frame, 1);
+
+    printf("Input to present: %u ms%s\n", latency_ms, over_budget ? " (over frame budget)" : "");
+}
+
+
+void report_latency(){
+    if (!measuring || latency_samples == 0) return;
+
+    printf("Input latency: %lu samples, mean %.1f ms, max %lu ms, %lu over the %u ms frame budget\n",
+           latency_samples, (double)latency_sum_ms / latency_samples, latency_max_ms, latency_over_budget, frame_budget_ms);
+}
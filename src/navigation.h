@@ -0,0 +1,32 @@
+#ifndef NAVIGATION_H
+    #define NAVIGATION_H
+
+    #include <SDL2/SDL.h>
+    #include "buttons.h"
+
+    // Held directions repeat after the delay, then once per interval.
+    #define NAVIGATION_REPEAT_DELAY_MS 400
+    #define NAVIGATION_REPEAT_INTERVAL_MS 80
+
+    #define CONTROLLER_AXIS_DEADZONE 16000
+    #define MAX_CONTROLLERS 4
+
+    // Frame budget used when the display doesn't report its refresh rate.
+    #define DEFAULT_REFRESH_RATE 60
+
+    typedef enum {
+        NAVIGATE_NONE, NAVIGATE_UP, NAVIGATE_DOWN, NAVIGATE_LEFT, NAVIGATE_RIGHT,
+        NAVIGATE_PREVIOUS, NAVIGATE_NEXT, NAVIGATE_ACTIVATE
+    } NavigationAction;
+
+    NavigationAction navigation_action(SDL_Event* event);
+    NavigationAction repeat_navigation();
+    void release_navigation();
+    Node* move_focus(Node* config, Node* focused, NavigationAction action);
+    void close_controllers();
+
+    void start_latency_measurement(SDL_Window* window);
+    void mark_input(Uint32 timestamp);
+    void mark_present();
+    void report_latency();
+#endif
@@ -0,0 +1,300 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <SDL2/SDL.h>
+#include "resolver.h"
+#include "tasks.h"
+
+typedef struct {
+    Button* button_ptr;
+    char* program;
+    int executable;
+} ResolveJob;
+
+// Unique programs of the config and where they resolved to, kept until PATH or the config change.
+static Executable* executables = NULL;
+static int executables_count = 0;
+static char* resolved_path_env = NULL;
+static Node* resolved_config = NULL;
+
+static ResolveJob* jobs = NULL;
+static int jobs_count = 0;
+static Bool resolution_pending = FALSE;
+
+// PATH directories, opened once per resolution so lookups don't walk the full path each time.
+static char* path_directories[MAX_PATH_DIRECTORIES];
+static int path_fds[MAX_PATH_DIRECTORIES];
+static int path_count = 0;
+
+static SDL_Thread* resolver_thread = NULL;
+static SDL_atomic_t resolution_done;
+
+// Shell builtins and keywords, the shell runs these itself so they are never looked up in PATH.
+static const char* shell_words[] = {
+    ".", ":", "[", "[[", "!", "{", "alias", "bg", "break", "builtin", "case", "cd", "command", "continue",
+    "declare", "do", "echo", "eval", "exec", "exit", "export", "false", "fg", "for", "function", "getopts",
+    "hash", "if", "jobs", "kill", "local", "printf", "pwd", "read", "readonly", "return", "select", "set",
+    "shift", "source", "test", "time", "times", "trap", "true", "type", "typeset", "ulimit", "umask",
+    "unalias", "unset", "until", "wait", "while", NULL
+};
+
+
+// First word of a command, or NULL when it is shell syntax we can't resolve on our own.
+static char* _program_name(const char* command){
+    if (command == NULL) return NULL;
+    command += strspn(command, " \t");
+    size_t length = strcspn(command, " \t");
+    if (length == 0) return NULL;
+
+    for (int index=0; shell_words[index]; index++)
+        if (strlen(shell_words[index]) == length && strncmp(command, shell_words[index], length) == 0) return NULL;
+
+    char* program = strndup(command, length);
+    if (strpbrk(program, "=$`'\"\\|;&<>(){}*?~")){
+        free(program);
+        return NULL;
+    }
+
+    return program;
+}
+
+
+static void _resolve_program(Executable* executable_ptr){
+    struct stat file_stat;
+
+    // Paths are checked as they are, names are looked up through PATH.
+    if (strchr(executable_ptr->program, '/')){
+        if (stat(executable_ptr->program, &file_stat) == -1) executable_ptr->status = PROGRAM_MISSING;
+        else if (!S_ISREG(file_stat.st_mode) || access(executable_ptr->program, X_OK) == -1)
+            executable_ptr->status = PROGRAM_NOT_EXECUTABLE;
+        else {
+            executable_ptr->status = PROGRAM_FOUND;
+            // Keep the path as written, symlinked programs may depend on the name they run as.
+            executable_ptr->path = strdup(executable_ptr->program);
+        }
+        return;
+    }
+
+    executable_ptr->status = PROGRAM_MISSING;
+    for (int index=0; index<path_count; index++){
+        if (path_fds[index] == -1) continue;
+        if (fstatat(path_fds[index], executable_ptr->program, &file_stat, 0) == -1 || !S_ISREG(file_stat.st_mode)) continue;
+
+        if (faccessat(path_fds[index], executable_ptr->program, X_OK, 0) == -1){
+            executable_ptr->status = PROGRAM_NOT_EXECUTABLE;
+            continue;
+        }
+
+        executable_ptr->status = PROGRAM_FOUND;
+        executable_ptr->path = __new_t(strlen(path_directories[index]) + strlen(executable_ptr->program) + 2, "string");
+        sprintf(executable_ptr->path, "%s/%s", path_directories[index], executable_ptr->program);
+        return;
+    }
+}
+
+
+static void _resolve_batch(void* data, int index){
+    int last = (index + 1) * RESOLVE_BATCH_SIZE;
+    if (last > executables_count) last = executables_count;
+
+    for (int executable=index * RESOLVE_BATCH_SIZE; executable<last; executable++)
+        _resolve_program(&executables[executable]);
+}
+
+
+static int _resolver(void* user){
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    // Split PATH, an empty entry means the current directory.
+    char* path_env = strdup(resolved_path_env);
+    char* cursor = path_env;
+    path_count = 0;
+    while (cursor && path_count < MAX_PATH_DIRECTORIES){
+        char* separator = strchr(cursor, ':');
+        if (separator) *separator = '\0';
+
+        // Absolute entries are kept as written, only relative ones get expanded.
+        path_directories[path_count] = *cursor == '/' ? strdup(cursor) : realpath(*cursor ? cursor : ".", NULL);
+        path_fds[path_count] = open(*cursor ? cursor : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (path_directories[path_count] == NULL && path_fds[path_count] != -1){
+            close(path_fds[path_count]);
+            path_fds[path_count] = -1;
+        }
+        path_count++;
+
+        cursor = separator ? separator + 1 : NULL;
+    }
+    free(path_env);
+
+    run_tasks(_resolve_batch, NULL, (executables_count + RESOLVE_BATCH_SIZE - 1) / RESOLVE_BATCH_SIZE);
+
+    for (int index=0; index<path_count; index++){
+        if (path_fds[index] != -1) close(path_fds[index]);
+        free(path_directories[index]);
+    }
+
+    double elapsed_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    printf("Resolved %d programs for %d buttons in %.2f ms\n", executables_count, jobs_count, elapsed_ms);
+
+    SDL_AtomicSet(&resolution_done, 1);
+    return 0;
+}
+
+
+static int _compare_jobs(const void* first, const void* second){
+    const ResolveJob* first_ptr = first;
+    const ResolveJob* second_ptr = second;
+    if (first_ptr->program == NULL || second_ptr->program == NULL)
+        return (first_ptr->program == NULL) - (second_ptr->program == NULL);
+    return strcmp(first_ptr->program, second_ptr->program);
+}
+
+
+static void _free_executables(){
+    for (int index=0; index<executables_count; index++){
+        free(executables[index].program);
+        free(executables[index].path);
+    }
+    free(executables);
+    executables = NULL;
+    executables_count = 0;
+
+    free(jobs);
+    jobs = NULL;
+    jobs_count = 0;
+}
+
+
+// Split the config into unique programs, one lookup each.
+static void _build_executables(Node* config){
+    jobs_count = 0;
+    for (Node* current = config; current != NULL; current = current->next) jobs_count++;
+    if (jobs_count == 0) return;
+
+    jobs = __new_t(jobs_count * sizeof(ResolveJob), "resolve jobs");
+    int index = 0;
+    for (Node* current = config; current != NULL; current = current->next, index++){
+        jobs[index].button_ptr = current->button_ptr;
+        jobs[index].program = _program_name(current->button_ptr->command);
+        jobs[index].executable = -1;
+    }
+
+    // Sorting puts buttons running the same program next to each other, so each one is looked up once.
+    qsort(jobs, jobs_count, sizeof(ResolveJob), _compare_jobs);
+    executables = __new_t(jobs_count * sizeof(Executable), "executables");
+    for (index=0; index<jobs_count && jobs[index].program; index++){
+        if (executables_count == 0 || strcmp(executables[executables_count-1].program, jobs[index].program) != 0){
+            executables[executables_count].program = jobs[index].program;
+            executables[executables_count].path = NULL;
+            executables[executables_count].status = PROGRAM_UNCHECKED;
+            executables_count++;
+        }
+        else free(jobs[index].program);
+
+        jobs[index].program = NULL;
+        jobs[index].executable = executables_count - 1;
+    }
+}
+
+
+static void _start_resolver(){
+    resolution_pending = TRUE;
+    SDL_AtomicSet(&resolution_done, 0);
+    resolver_thread = SDL_CreateThread(_resolver, "command_resolver", NULL);
+    if (resolver_thread == NULL) _resolver(NULL);
+}
+
+
+// Resolve every button's program to an absolute path in the background. Does
+// nothing while PATH and the config stay the same as for the last resolution.
+void start_command_resolution(Node* config){
+    if (resolver_thread || resolution_pending) return;
+
+    const char* path_env = getenv("PATH");
+    if (path_env == NULL) path_env = "";
+    if (config == resolved_config && resolved_path_env && strcmp(path_env, resolved_path_env) == 0) return;
+
+    _free_executables();
+    free(resolved_path_env);
+    resolved_path_env = strdup(path_env);
+    resolved_config = config;
+    _build_executables(config);
+    if (jobs_count > 0) _start_resolver();
+}
+
+
+// Look the already known programs up again, for when a launched program may have
+// installed or removed some of them.
+void recheck_command_resolution(){
+    if (resolver_thread || resolution_pending || jobs_count == 0) return;
+
+    for (int index=0; index<executables_count; index++){
+        free(executables[index].path);
+        executables[index].path = NULL;
+        executables[index].status = PROGRAM_UNCHECKED;
+    }
+    _start_resolver();
+}
+
+
+// Quote an absolute path for the shell, NULL when it can't be done simply.
+static char* _resolved_command(const char* path, const char* command){
+    if (strchr(path, '\'')) return NULL;
+
+    // Keep everything after the program name as it was written.
+    command += strspn(command, " \t");
+    const char* arguments = command + strcspn(command, " \t");
+
+    char* resolved = __new_t(strlen(path) + strlen(arguments) + 3, "string");
+    sprintf(resolved, "'%s'%s", path, arguments);
+    return resolved;
+}
+
+
+// Hand the results of a finished resolution over to the buttons, from the main
+// thread. Returns TRUE when there was something to apply.
+Bool apply_resolved_commands(Node* config){
+    if (!resolution_pending || !SDL_AtomicGet(&resolution_done)) return FALSE;
+
+    if (resolver_thread) SDL_WaitThread(resolver_thread, NULL);
+    resolver_thread = NULL;
+
+    for (int index=0; index<jobs_count && config == resolved_config; index++){
+        Button* btn_ptr = jobs[index].button_ptr;
+        Bool was_broken = btn_ptr->is_broken;
+        free((char*)btn_ptr->launch_command);
+        btn_ptr->launch_command = NULL;
+        btn_ptr->is_broken = btn_ptr->command == NULL;
+
+        Executable* executable_ptr = jobs[index].executable == -1 ? NULL : &executables[jobs[index].executable];
+        if (executable_ptr && executable_ptr->status == PROGRAM_FOUND)
+            btn_ptr->launch_command = _resolved_command(executable_ptr->path, btn_ptr->command);
+        else if (executable_ptr) btn_ptr->is_broken = TRUE;
+
+        // Only report buttons that changed since the last resolution.
+        if (btn_ptr->is_broken == was_broken) continue;
+        if (!btn_ptr->is_broken) printf("%s: \"%s\" is available again\n", btn_ptr->label, executable_ptr->program);
+        else if (executable_ptr == NULL) fprintf(stderr, "%s: has no command\n", btn_ptr->label);
+        else fprintf(stderr, "%s: \"%s\" %s\n", btn_ptr->label, executable_ptr->program,
+                     executable_ptr->status == PROGRAM_MISSING ? "was not found" : "is not executable");
+    }
+
+    resolution_pending = FALSE;
+    return TRUE;
+}
+
+
+void stop_command_resolution(){
+    if (resolver_thread) SDL_WaitThread(resolver_thread, NULL);
+    resolver_thread = NULL;
+
+    resolution_pending = FALSE;
+    _free_executables();
+    free(resolved_path_env);
+    resolved_path_env = NULL;
+    resolved_config = NULL;
+}
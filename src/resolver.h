@@ -0,0 +1,25 @@
+#ifndef RESOLVER_H
+    #define RESOLVER_H
+
+    #include <SDL2/SDL.h>
+    #include "buttons.h"
+
+    // Programs looked up per task when resolving in parallel.
+    #define RESOLVE_BATCH_SIZE 32
+
+    // Most directories taken from PATH.
+    #define MAX_PATH_DIRECTORIES 64
+
+    typedef enum {PROGRAM_UNCHECKED, PROGRAM_FOUND, PROGRAM_MISSING, PROGRAM_NOT_EXECUTABLE} ProgramStatus;
+
+    typedef struct {
+        char* program;
+        char* path;
+        ProgramStatus status;
+    } Executable;
+
+    void start_command_resolution(Node* config);
+    void recheck_command_resolution();
+    Bool apply_resolved_commands(Node* config);
+    void stop_command_resolution();
+#endif
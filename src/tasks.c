@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include "tasks.h"
+
+typedef struct {
+    TaskFunction task;
+    void* data;
+    int task_count;
+    SDL_atomic_t next_index;
+} TaskQueue;
+
+
+static int _worker(void* user){
+    TaskQueue* queue = (TaskQueue*)user;
+
+    // Keep pulling the next pending index until every task has been taken.
+    int index;
+    while ((index = SDL_AtomicAdd(&queue->next_index, 1)) < queue->task_count)
+        queue->task(queue->data, index);
+
+    return 0;
+}
+
+
+// Run task(data, index) for every index in [0, task_count) on a pool of threads
+// sized after the core count, and return once all of them are done.
+void run_tasks(TaskFunction task, void* data, int task_count){
+    TaskQueue queue = {task, data, task_count, {0}};
+
+    int workers_count = SDL_GetCPUCount();
+    if (workers_count > task_count) workers_count = task_count;
+    if (workers_count > MAX_WORKERS) workers_count = MAX_WORKERS;
+
+    // The calling thread works too, so only spawn the extra ones.
+    SDL_Thread* workers[MAX_WORKERS];
+    int spawned = 0;
+    for (int index=1; index<workers_count; index++){
+        workers[spawned] = SDL_CreateThread(_worker, "task_worker", &queue);
+        if (workers[spawned] == NULL){
+            fprintf(stderr, "Failed to create worker thread: %s\n", SDL_GetError());
+            break;
+        }
+        spawned++;
+    }
+
+    _worker(&queue);
+
+    for (int index=0; index<spawned; index++)
+        SDL_WaitThread(workers[index], NULL);
+}
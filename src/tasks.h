@@ -0,0 +1,9 @@
+#ifndef TASKS_H
+    #define TASKS_H
+
+    #define MAX_WORKERS 16
+
+    typedef void (*TaskFunction)(void* data, int index);
+
+    void run_tasks(TaskFunction task, void* data, int task_count);
+#endif